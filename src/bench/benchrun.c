@@ -0,0 +1,116 @@
+/** @file benchrun.c
+ *  @brief Runs a cachesim binary over trace files and reports its throughput
+ *  and peak memory use.
+ *
+ *  Each trace is simulated several times with the simulator's stdout thrown
+ *  away. The fastest wall-clock run is reported together with the largest
+ *  resident set size seen, both taken from the child process itself.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "../byutr.h"
+
+static double now_seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int run_once(const char *cachesim, const char *trace, double *seconds, long *maxrss_kb)
+//Runs cachesim on one trace. Returns the exit status, -1 if the child could not be started
+{
+  double start = now_seconds();
+  pid_t pid = fork();
+  if (pid < 0)
+    return -1;
+  if (pid == 0)
+  {
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0)
+      dup2(devnull, STDOUT_FILENO);
+    execl(cachesim, cachesim, trace, (char *)NULL);
+    _exit(127);
+  }
+
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) < 0)
+    return -1;
+  *seconds = now_seconds() - start;
+  *maxrss_kb = usage.ru_maxrss; // kilobytes on Linux
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+int main(int argc, char *argv[])
+{
+  int repeats = 3;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "r:")) != -1)
+  {
+    if (opt == 'r')
+      repeats = atoi(optarg);
+    else
+    {
+      printf("Usage: %s [-r repeats] label cachesim trace...\n", argv[0]);
+      exit(1);
+    }
+  }
+  if (argc - optind < 3 || repeats < 1)
+  {
+    printf("Usage: %s [-r repeats] label cachesim trace...\n", argv[0]);
+    exit(1);
+  }
+
+  const char *label = argv[optind];
+  const char *cachesim = argv[optind + 1];
+  int failed = 0;
+
+  for (int i = optind + 2; i < argc; i++)
+  {
+    struct stat st;
+    if (stat(argv[i], &st) != 0)
+    {
+      printf("Could not open file: %s\n", argv[i]);
+      failed = 1;
+      continue;
+    }
+    uint64_t accesses = st.st_size / sizeof(p2AddrTr);
+
+    double best = 0.0;
+    long peak_rss = 0;
+    for (int r = 0; r < repeats; r++)
+    {
+      double seconds;
+      long rss;
+      int status = run_once(cachesim, argv[i], &seconds, &rss);
+      if (status != 0)
+      {
+        printf("%s failed on %s (status %d)\n", cachesim, argv[i], status);
+        failed = 1;
+        break;
+      }
+      if (r == 0 || seconds < best)
+        best = seconds;
+      if (rss > peak_rss)
+        peak_rss = rss;
+    }
+
+    const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+    printf("%-24s %-14s accesses: %10llu  time: %8.4fs  [%8.2f M accesses/s]  peak RSS: %6ld KiB\n",
+           label, name, (unsigned long long)accesses, best,
+           best > 0.0 ? accesses / best / 1e6 : 0.0, peak_rss);
+  }
+
+  return failed;
+}
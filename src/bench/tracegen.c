@@ -0,0 +1,274 @@
+/** @file tracegen.c
+ *  @brief Generates synthetic memory traces in the BYU format read by cachesim.
+ *
+ *  Every pattern is fully determined by its arguments and the seed, so the
+ *  same command line always produces a byte-identical trace.
+ *  @see byutr.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "../byutr.h"
+
+#define CODE_BASE 0x04000000ULL
+#define DATA_BASE 0x10000000ULL
+#define LINE 64
+#define WORD 8
+#define BUFFERED_RECORDS 4096
+
+typedef struct // parameters shared by all patterns
+{
+  uint64_t accesses;    // number of trace records to emit
+  uint64_t working_set; // bytes of data touched by the pattern
+  uint64_t stride;      // bytes between accesses for the strided pattern
+  uint64_t seed;
+} GenConfig;
+
+static FILE *out;
+static p2AddrTr buffer[BUFFERED_RECORDS];
+static int buffered;
+static uint64_t emitted;
+static uint64_t limit; // records past this are dropped so the trace length is exact
+static uint64_t rng_state;
+
+static void flush_records(void)
+{
+  if (buffered && fwrite(buffer, sizeof(p2AddrTr), buffered, out) != (size_t)buffered)
+  {
+    perror("tracegen: write");
+    exit(1);
+  }
+  buffered = 0;
+}
+
+static void emit(uint8_t reqtype, uint64_t address, uint8_t size)
+{
+  if (emitted == limit)
+    return;
+  p2AddrTr *tr = &buffer[buffered++];
+  memset(tr, 0, sizeof(*tr));
+  tr->addr = address;
+  tr->reqtype = reqtype;
+  tr->size = size;
+  emitted++;
+  if (buffered == BUFFERED_RECORDS)
+    flush_records();
+}
+
+static uint64_t next_random(void)
+// xorshift64*, good enough for address streams and identical on every platform
+{
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static void gen_stream(GenConfig *cfg)
+// Copy loop: load src[i], store dst[i], wrapping over the working set
+{
+  uint64_t half = cfg->working_set / 2;
+  uint64_t offset = 0;
+  while (emitted < cfg->accesses)
+  {
+    emit(MEMREAD, DATA_BASE + offset, WORD);
+    emit(MEMWRITE, DATA_BASE + half + offset, WORD);
+    offset = (offset + WORD) % half;
+  }
+}
+
+static void gen_stride(GenConfig *cfg)
+// Loads with a fixed stride, shifted by one word every pass so all words get touched
+{
+  // the shift wraps inside both the stride and the working set, so a stride wider
+  // than the working set still stays inside it
+  uint64_t wrap = cfg->stride < cfg->working_set ? cfg->stride : cfg->working_set;
+  uint64_t offset = 0;
+  uint64_t pass = 0;
+  while (emitted < cfg->accesses)
+  {
+    emit(MEMREAD, DATA_BASE + offset, WORD);
+    offset += cfg->stride;
+    if (offset >= cfg->working_set)
+    {
+      pass++;
+      offset = (pass * WORD) % wrap;
+    }
+  }
+}
+
+static void gen_random(GenConfig *cfg)
+// Uniform random words in the working set, one in four is a store
+{
+  uint64_t words = cfg->working_set / WORD;
+  while (emitted < cfg->accesses)
+  {
+    uint64_t r = next_random();
+    emit((r & 3) == 0 ? MEMWRITE : MEMREAD, DATA_BASE + ((r >> 2) % words) * WORD, WORD);
+  }
+}
+
+static void gen_chase(GenConfig *cfg)
+// Follows a single random cycle through every line of the working set (Sattolo's algorithm)
+{
+  uint64_t lines = cfg->working_set / LINE;
+  uint64_t *next = malloc(sizeof(uint64_t) * lines);
+  if (next == NULL)
+  {
+    fprintf(stderr, "tracegen: working set too large for pointer chase\n");
+    exit(1);
+  }
+  for (uint64_t i = 0; i < lines; i++)
+    next[i] = i;
+  for (uint64_t i = lines - 1; i > 0; i--)
+  {
+    uint64_t j = next_random() % i;
+    uint64_t tmp = next[i];
+    next[i] = next[j];
+    next[j] = tmp;
+  }
+
+  uint64_t current = 0;
+  while (emitted < cfg->accesses)
+  {
+    emit(MEMREAD, DATA_BASE + current * LINE, WORD);
+    current = next[current];
+  }
+  free(next);
+}
+
+static void gen_loopnest(GenConfig *cfg)
+// Naive i-j-k matrix multiply C += A * B over three square matrices of doubles
+{
+  uint64_t n = 1;
+  while ((n + 1) * (n + 1) * WORD * 3 <= cfg->working_set)
+    n++;
+  uint64_t matrix = n * n * WORD;
+  uint64_t a = DATA_BASE, b = a + matrix, c = b + matrix;
+
+  while (emitted < cfg->accesses)
+    for (uint64_t i = 0; i < n && emitted < cfg->accesses; i++)
+      for (uint64_t j = 0; j < n && emitted < cfg->accesses; j++)
+      {
+        for (uint64_t k = 0; k < n && emitted < cfg->accesses; k++)
+        {
+          emit(MEMREAD, a + (i * n + k) * WORD, WORD);
+          emit(MEMREAD, b + (k * n + j) * WORD, WORD);
+        }
+        emit(MEMWRITE, c + (i * n + j) * WORD, WORD);
+      }
+}
+
+static void gen_mixed(GenConfig *cfg)
+// Instruction fetches from a 16 KiB loop body with a data access every other instruction,
+// data is half streaming and half random with one in four accesses a store
+{
+  const uint64_t code_size = 16 * 1024;
+  uint64_t pc = 0;
+  uint64_t stream = 0;
+  uint64_t words = cfg->working_set / WORD;
+  while (emitted < cfg->accesses)
+  {
+    emit(FETCH, CODE_BASE + pc, 4);
+    pc = (pc + 4) % code_size;
+    if (pc % 8)
+      continue;
+
+    uint64_t r = next_random();
+    uint64_t address;
+    if (r & 1)
+    {
+      address = DATA_BASE + stream;
+      stream = (stream + WORD) % cfg->working_set;
+    }
+    else
+      address = DATA_BASE + ((r >> 3) % words) * WORD;
+    emit((r & 6) == 0 ? MEMWRITE : MEMREAD, address, WORD);
+  }
+}
+
+typedef struct
+{
+  const char *name;
+  void (*generate)(GenConfig *cfg);
+} Pattern;
+
+static const Pattern patterns[] = {
+    {"stream", gen_stream},
+    {"stride", gen_stride},
+    {"random", gen_random},
+    {"chase", gen_chase},
+    {"loopnest", gen_loopnest},
+    {"mixed", gen_mixed},
+};
+
+static void usage(const char *program)
+{
+  printf("Usage: %s [-n accesses] [-w working_set_bytes] [-s stride_bytes] [-r seed] -o file pattern\n", program);
+  printf("Patterns:");
+  for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++)
+    printf(" %s", patterns[i].name);
+  printf("\n");
+  exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+  GenConfig cfg = {1000000, 1 << 20, 4096 + LINE, 1};
+  const char *filename = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:w:s:r:o:")) != -1)
+  {
+    switch (opt)
+    {
+    case 'n':
+      cfg.accesses = strtoull(optarg, NULL, 0);
+      break;
+    case 'w':
+      cfg.working_set = strtoull(optarg, NULL, 0);
+      break;
+    case 's':
+      cfg.stride = strtoull(optarg, NULL, 0);
+      break;
+    case 'r':
+      cfg.seed = strtoull(optarg, NULL, 0);
+      break;
+    case 'o':
+      filename = optarg;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (optind != argc - 1 || filename == NULL)
+    usage(argv[0]);
+  if (cfg.working_set < 2 * LINE || cfg.stride < WORD)
+  {
+    fprintf(stderr, "tracegen: working set must be at least %d bytes and stride at least %d\n", 2 * LINE, WORD);
+    exit(1);
+  }
+
+  const Pattern *pattern = NULL;
+  for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++)
+    if (strcmp(argv[optind], patterns[i].name) == 0)
+      pattern = &patterns[i];
+  if (pattern == NULL)
+    usage(argv[0]);
+
+  if ((out = fopen(filename, "wb")) == NULL)
+  {
+    printf("Could not open file: %s\n", filename);
+    exit(1);
+  }
+  rng_state = cfg.seed ? cfg.seed : 1;
+  limit = cfg.accesses;
+
+  pattern->generate(&cfg);
+  flush_records();
+  fclose(out);
+  return 0;
+}
@@ -6,60 +6,157 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include "memory.h"
 #include "byutr.h"
+#include "profile.h"
+#include "regions.h"
+#include "lackey.h"
+
+#define BATCH_RECORDS 4096
+
+static p2AddrTr batch[BATCH_RECORDS];
 
 /*
- * Command line argument: Trace file.
+ * Command line arguments: [options] Trace file, or - to read a lackey log from stdin.
+ *   --lackey              Trace file is a valgrind lackey text log, not a .tr file.
+ *   --seed N              Seed for the random replacement policy (default 1).
+ *   --profile             Print the hot-path profile (needs 'make PROFILE=1').
+ *   --regions PAGE_SIZE   Attribute misses and write-backs to PAGE_SIZE byte regions.
+ *   --region-file FILE    Attribute them to the "name start end" ranges in FILE instead.
+ *   --top N               Number of regions in the heatmap report (default 10).
+ *   --csv FILE            Also write every region to FILE as CSV.
  */
 int main(int argc, char *argv[])
 {
   FILE *tracef;
-  p2AddrTr tr;
+  LackeyReader *reader = NULL;
+  const char *filename = NULL;
+  int profile = 0;
+  int lackey = 0;
+  int regions = 0;
+  uint64_t region_page_size = 4096;
+  const char *region_file = NULL;
+  int region_top = 10;
+  const char *region_csv = NULL;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--profile") == 0)
+      profile = 1;
+    else if (strcmp(argv[i], "--lackey") == 0)
+      lackey = 1;
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+      memory_set_seed(strtoull(argv[++i], NULL, 0));
+    else if (strcmp(argv[i], "--regions") == 0 && i + 1 < argc)
+    {
+      regions = 1;
+      region_page_size = strtoull(argv[++i], NULL, 0);
+    }
+    else if (strcmp(argv[i], "--region-file") == 0 && i + 1 < argc)
+    {
+      regions = 1;
+      region_file = argv[++i];
+    }
+    else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc)
+      region_top = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+    {
+      regions = 1;
+      region_csv = argv[++i];
+    }
+    else
+      filename = argv[i];
+  }
 
-  if (argc < 2)
+  if (filename == NULL)
   {
-    printf("Usage: %s filename\n", argv[0]);
+    printf("Usage: %s [--lackey] [--seed N] [--profile] [--regions PAGE_SIZE | --region-file FILE] [--top N] [--csv FILE] filename|-\n", argv[0]);
     exit(1);
   }
 
+  if (regions && regions_init(region_page_size, region_file, region_top, region_csv) != 0)
+    exit(1);
+
+  if (profile)
+  {
+#ifdef CACHESIM_PROFILE
+    profile_enable();
+#else
+    fprintf(stderr, "Profiling is not compiled in, rebuild with 'make PROFILE=1'\n");
+#endif
+  }
+
   /* fopen(argv[1], "r") -> fopen(argv[1], "rb")
    * Windows doesn't follow POSIX here and fopen needs the 'b' to function
    * properly.
    */
-  if ((tracef = fopen(argv[1], "rb")) == NULL)
+  if (strcmp(filename, "-") == 0)
+  {
+    tracef = stdin;
+    lackey = 1;
+  }
+  else if ((tracef = fopen(filename, lackey ? "r" : "rb")) == NULL)
   {
-    printf("Could not open file: %s\n", argv[1]);
+    printf("Could not open file: %s\n", filename);
+    exit(1);
+  }
+
+  if (lackey && (reader = lackey_open(tracef)) == NULL)
+  {
+    printf("Could not allocate lackey reader\n");
     exit(1);
   }
 
   memory_init(); /* Initialize the memory subsystem */
 
-  /* Loop through the trace file and simulate memory accesses */
-  while (!feof(tracef))
+  /* Read the trace in batches and simulate memory accesses */
+  for (;;)
   {
-    if (fread(&tr, sizeof(p2AddrTr), 1, tracef) == 1)
+    PROFILE_BEGIN(PROF_TRACE_READ, prof_start);
+    size_t records = reader ? lackey_read(reader, batch, BATCH_RECORDS)
+                            : fread(batch, sizeof(p2AddrTr), BATCH_RECORDS, tracef);
+    PROFILE_END(PROF_TRACE_READ, prof_start);
+    if (records == 0)
+      break;
+
+    for (size_t i = 0; i < records; i++)
     {
-      switch (tr.reqtype)
+      switch (batch[i].reqtype)
       {
       case FETCH:
-        memory_fetch(tr.addr, NULL);
+        memory_fetch(batch[i].addr, NULL);
         break;
       case MEMREAD:
-        memory_read(tr.addr, NULL);
+        memory_read(batch[i].addr, NULL);
         break;
       case MEMWRITE:
-        memory_write(tr.addr, NULL);
+        memory_write(batch[i].addr, NULL);
         break;
       default:
-        printf("Ignoring trace record with type %d\n", tr.reqtype);
+        printf("Ignoring trace record with type %d\n", batch[i].reqtype);
       }
     }
   }
 
-  fclose(tracef);
+  if (reader)
+  {
+    uint64_t malformed = lackey_close(reader);
+    if (malformed)
+      fprintf(stderr, "Skipped %llu malformed lackey lines\n", (unsigned long long)malformed);
+  }
+  if (tracef != stdin)
+    fclose(tracef);
 
   memory_finish(); /* Deinitialize the memory subsystem */
 
+  if (regions)
+    regions_report();
+
+#ifdef CACHESIM_PROFILE
+  if (profile_enabled)
+    profile_report();
+#endif
+
   return 0;
 }
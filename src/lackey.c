@@ -0,0 +1,178 @@
+/** @file lackey.c
+ *  @brief Streaming parser for valgrind lackey text logs.
+ *  @see lackey.h
+ */
+
+#include "lackey.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LACKEY_BUFFER_SIZE (1 << 20)
+#define HEX_INVALID 0xff
+
+struct LackeyReader
+{
+  FILE *f;
+  char *buffer;
+  size_t start; // first unparsed byte
+  size_t end;   // one past the last byte read
+  int eof;
+  int skip_line; // rest of an overlong line is still to come
+  uint64_t malformed;
+};
+
+static uint8_t hex_value[256];
+static int hex_ready;
+
+static void init_hex_table(void)
+{
+  memset(hex_value, HEX_INVALID, sizeof(hex_value));
+  for (int i = 0; i < 10; i++)
+    hex_value['0' + i] = i;
+  for (int i = 0; i < 6; i++)
+  {
+    hex_value['a' + i] = 10 + i;
+    hex_value['A' + i] = 10 + i;
+  }
+  hex_ready = 1;
+}
+
+LackeyReader *lackey_open(FILE *f)
+{
+  LackeyReader *reader = calloc(1, sizeof(LackeyReader));
+  if (reader == NULL)
+    return NULL;
+  reader->buffer = malloc(LACKEY_BUFFER_SIZE);
+  if (reader->buffer == NULL)
+  {
+    free(reader);
+    return NULL;
+  }
+  reader->f = f;
+  if (!hex_ready)
+    init_hex_table();
+  return reader;
+}
+
+static void refill(LackeyReader *reader)
+//Moves the unparsed tail to the front of the buffer and fills the rest from the stream
+{
+  size_t left = reader->end - reader->start;
+  memmove(reader->buffer, reader->buffer + reader->start, left);
+  reader->start = 0;
+  reader->end = left;
+  size_t got = fread(reader->buffer + left, 1, LACKEY_BUFFER_SIZE - left, reader->f);
+  reader->end += got;
+  if (got == 0)
+    reader->eof = 1;
+}
+
+static int parse_line(const char *p, const char *end, p2AddrTr *tr)
+/*
+Parses one line without its newline, e.g. "I  0401f540,3" or " S 1fff0005a8,8".
+Returns 1 for a memory record, 0 for comments, blank lines and M records, -1 if malformed.
+*/
+{
+  while (p < end && *p == ' ')
+    p++;
+  if (p == end || *p == '=')
+    return 0;
+
+  char type = *p++;
+  if (p == end || *p != ' ')
+    return -1;
+  while (p < end && *p == ' ')
+    p++;
+
+  uint64_t address = 0;
+  const char *digits = p;
+  while (p < end && hex_value[(uint8_t)*p] != HEX_INVALID)
+    address = (address << 4) | hex_value[(uint8_t)*p++];
+  if (p == digits || p == end || *p != ',')
+    return -1;
+  p++;
+
+  unsigned size = 0;
+  const char *size_digits = p;
+  while (p < end && *p >= '0' && *p <= '9')
+    size = size * 10 + (*p++ - '0');
+  if (p == size_digits)
+    return -1;
+
+  switch (type)
+  {
+  case 'I':
+    tr->reqtype = FETCH;
+    break;
+  case 'L':
+    tr->reqtype = MEMREAD;
+    break;
+  case 'S':
+    tr->reqtype = MEMWRITE;
+    break;
+  case 'M': // Data modify, skipped like traceconverter.py does
+    return 0;
+  default:
+    return -1;
+  }
+  tr->addr = address;
+  tr->size = size;
+  tr->attr = 0;
+  tr->proc = 0;
+  tr->time = 0;
+  return 1;
+}
+
+size_t lackey_read(LackeyReader *reader, p2AddrTr *batch, size_t max)
+{
+  size_t count = 0;
+  while (count < max)
+  {
+    char *line = reader->buffer + reader->start;
+    char *newline = memchr(line, '\n', reader->end - reader->start);
+    if (newline == NULL)
+    {
+      if (!reader->eof)
+      {
+        if (reader->start == 0 && reader->end == LACKEY_BUFFER_SIZE)
+        {
+          // a line longer than the whole buffer is never a memory record, count it once
+          if (!reader->skip_line)
+            reader->malformed++;
+          reader->skip_line = 1;
+          reader->end = 0;
+        }
+        refill(reader);
+        continue;
+      }
+      if (reader->start == reader->end)
+        break;
+      newline = reader->buffer + reader->end; // last line without a newline
+    }
+
+    char *line_end = newline;
+    if (line_end > line && line_end[-1] == '\r')
+      line_end--;
+    int result = reader->skip_line ? 0 : parse_line(line, line_end, &batch[count]);
+    reader->skip_line = 0;
+    if (result == 1)
+      count++;
+    else if (result < 0)
+      reader->malformed++;
+    reader->start = newline - reader->buffer;
+    if (reader->start < reader->end)
+      reader->start++;
+  }
+  return count;
+}
+
+uint64_t lackey_close(LackeyReader *reader)
+{
+  uint64_t malformed = reader->malformed;
+  free(reader->buffer);
+  free(reader);
+  return malformed;
+}
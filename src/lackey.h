@@ -0,0 +1,41 @@
+/** @file lackey.h
+ *  @brief Reads valgrind lackey text logs directly, without traceconverter.py.
+ *
+ *  Records are parsed the same way as traceconverter.py: "==" lines are
+ *  comments, I/L/S become FETCH/MEMREAD/MEMWRITE and M (modify) records are
+ *  skipped. Lines that do not parse are counted and skipped.
+ *  @see lackey.c
+ */
+
+#ifndef LACKEY_H
+#define LACKEY_H
+#include <stdio.h>
+#include <stdint.h>
+#include "byutr.h"
+
+typedef struct LackeyReader LackeyReader;
+
+/** Start reading lackey text from an open stream, for example stdin.
+ *
+ *  @param[in] f Stream positioned at the start of the log.
+ *  @return New reader, or NULL if out of memory.
+ */
+LackeyReader *lackey_open(FILE *f);
+
+/** Parse the next batch of memory records.
+ *
+ *  @param[in] reader Reader returned by lackey_open().
+ *  @param[out] batch Array receiving the records.
+ *  @param[in] max Capacity of batch.
+ *  @return Number of records stored, 0 once the stream is exhausted.
+ */
+size_t lackey_read(LackeyReader *reader, p2AddrTr *batch, size_t max);
+
+/** Free the reader. The stream itself is left open.
+ *
+ *  @param[in] reader Reader returned by lackey_open().
+ *  @return Number of malformed lines that were skipped.
+ */
+uint64_t lackey_close(LackeyReader *reader);
+
+#endif // lackey.h
@@ -5,15 +5,17 @@
  */
 
 #include "memory.h"
+#include "profile.h"
+#include "regions.h"
 
 #include <stdio.h>
 #include <stdint.h>
 #include <inttypes.h>
 #include <stdlib.h>
 #include <math.h>
-#include <time.h>
 
 static unsigned long instr_count;
+static uint64_t random_seed = 1; // same seed every run unless memory_set_seed is called
 
 typedef enum // enum for write policy for easy readability 
 {
@@ -82,6 +84,7 @@ typedef struct // Structure of a cache
   int amount_sets;
   CacheSet *sets;
   WritePolicies write_policy;
+  uint64_t rng_state; // xorshift64* state for the random replacement policy, never 0
 } Cache;
 
 Cache *L1D;
@@ -89,29 +92,84 @@ Cache *L1I;
 Cache *L2;
 
 // --------------------------- Changeable configurations to optimize the cache ------------------- //
-#define L1I_size 512 
+// Each value can be overridden at compile time, e.g. -DL1D_replacement_policy=RANDOM
+#ifndef L1I_size
+#define L1I_size 512
+#endif
+#ifndef L1I_associativity
 #define L1I_associativity 2
-#define L1I_mapping SET_ASSOCIATIVE_MAPPING 
+#endif
+#ifndef L1I_mapping
+#define L1I_mapping SET_ASSOCIATIVE_MAPPING
+#endif
+#ifndef L1I_replacement_policy
 #define L1I_replacement_policy LRU
+#endif
+#ifndef L1I_line_size
 #define L1I_line_size 64
+#endif
+#ifndef L1I_bus_width
 #define L1I_bus_width 64
+#endif
+#ifndef L1I_write_policy
 #define L1I_write_policy WRITE_BACK
-
-#define L1D_size 512                
-#define L1D_associativity 2       
-#define L1D_mapping SET_ASSOCIATIVE_MAPPING 
+#endif
+
+#ifndef L1D_size
+#define L1D_size 512
+#endif
+#ifndef L1D_associativity
+#define L1D_associativity 2
+#endif
+#ifndef L1D_mapping
+#define L1D_mapping SET_ASSOCIATIVE_MAPPING
+#endif
+#ifndef L1D_replacement_policy
 #define L1D_replacement_policy LRU
+#endif
+#ifndef L1D_line_size
 #define L1D_line_size 64
-#define L1D_bus_width 64 
+#endif
+#ifndef L1D_bus_width
+#define L1D_bus_width 64
+#endif
+#ifndef L1D_write_policy
 #define L1D_write_policy WRITE_BACK
+#endif
 
+#ifndef L2_size
 #define L2_size 1024 // 4kb
+#endif
+#ifndef L2_associativity
 #define L2_associativity 2
+#endif
+#ifndef L2_mapping
 #define L2_mapping SET_ASSOCIATIVE_MAPPING
+#endif
+#ifndef L2_replacement_policy
 #define L2_replacement_policy LRU
+#endif
+#ifndef L2_line_size
 #define L2_line_size 64
+#endif
+#ifndef L2_bus_width
 #define L2_bus_width 64
+#endif
+#ifndef L2_write_policy
 #define L2_write_policy WRITE_BACK
+#endif
+
+#ifdef CACHESIM_PROFILE
+static ProfileLevel profile_level(Cache *currentCache)
+//Maps a cache to the level used for its lookup-length histogram
+{
+  if (currentCache == L1I)
+    return PROF_L1I;
+  if (currentCache == L1D)
+    return PROF_L1D;
+  return PROF_L2;
+}
+#endif
 
 int calculate_number_sets(Cache *currentCache)
 // Calculates the number of sets and returns the amount.
@@ -177,10 +235,25 @@ Cache *cache_initialization(
   return currentCache;
 }
 
+void memory_set_seed(uint64_t seed)
+//Sets the seed memory_init uses for the per-cache random generators
+{
+  random_seed = seed;
+}
+
+uint64_t seed_cache(uint64_t seed, uint64_t cache_number)
+//Derives an independent, non-zero xorshift state per cache from the global seed using splitmix64
+{
+  uint64_t z = seed + (cache_number + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  return z ? z : 1;
+}
+
 void memory_init(void)
 //initializes memory for everything that needs to have allocated memory
 {
-  srand(time(NULL));
   L1D = (Cache *)malloc(sizeof(Cache));
   L1I = (Cache *)malloc(sizeof(Cache));
   L2 = (Cache *)malloc(sizeof(Cache));
@@ -198,6 +271,10 @@ void memory_init(void)
                        L2_mapping, L2_replacement_policy,
                        L2_line_size, L2_bus_width, L2_write_policy);
 
+  L1I->rng_state = seed_cache(random_seed, 0);
+  L1D->rng_state = seed_cache(random_seed, 1);
+  L2->rng_state = seed_cache(random_seed, 2);
+
   // when added more mappings, change so that the function takes in the mapping as argument
   // and differentiate what is allocated in the function instead of if statements in memory_init.
   if (L1D_mapping == DIRECT_MAPPING)
@@ -246,6 +323,7 @@ tag = adressbits - (offset + index) // aka remaining bits
 tag_bit = ((1<<12)-1) & adress      - Gives us the tag bits of the adress
 */
   // calculating offset
+  PROFILE_BEGIN_SAMPLED(PROF_TAG_INDEX_OFFSET, prof_start);
   AdressParts tag_index_offset;
 
   int offsetBits = log2(currentCache->line_size);
@@ -260,13 +338,28 @@ tag_bit = ((1<<12)-1) & adress      - Gives us the tag bits of the adress
 
   // Calculate tag
   tag_index_offset.tag = adress >> (indexBits + offsetBits);
+  PROFILE_END(PROF_TAG_INDEX_OFFSET, prof_start);
   return tag_index_offset;
 }
 
+int RandomWay(Cache *currentCache)
+//Picks a way uniformly at random from the cache's own xorshift64* generator. Scaling the top 32 bits
+//by the associativity with a multiply and shift avoids the division of rand() % associativity.
+{
+  uint64_t x = currentCache->rng_state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  currentCache->rng_state = x;
+  uint64_t r = (x * 0x2545F4914F6CDD1DULL) >> 32;
+  return (int)((r * (uint64_t)currentCache->associativity) >> 32);
+}
+
 int CacheLookup(Cache *currentCache, uint64_t adress)
 //Function for looking for a adress in the current cache. If the adress is found it returns 1 else it returns 0
 {
   AdressParts tag_index_offset = GetTagIndexOffset(currentCache, adress);
+  PROFILE_BEGIN_SAMPLED(PROF_LOOKUP_SCAN, prof_start);
 
   // lookup for directmapping
   if (currentCache->mapping == DIRECT_MAPPING)
@@ -275,6 +368,8 @@ int CacheLookup(Cache *currentCache, uint64_t adress)
 
     if (line->valid == 1 && line->tag == tag_index_offset.tag)
     {
+      PROFILE_END(PROF_LOOKUP_SCAN, prof_start);
+      PROFILE_LOOKUP(profile_level(currentCache), 1);
       return 1;
     }
   }
@@ -289,11 +384,15 @@ int CacheLookup(Cache *currentCache, uint64_t adress)
 
       if (line->valid == 1 && line->tag == tag_index_offset.tag)
       {
+        PROFILE_END(PROF_LOOKUP_SCAN, prof_start);
+        PROFILE_LOOKUP(profile_level(currentCache), i + 1);
         return 1;
       }
     }
   }
 
+  PROFILE_END(PROF_LOOKUP_SCAN, prof_start);
+  PROFILE_LOOKUP(profile_level(currentCache), 0);
   return 0; // returns 0 for no found adress with valid bit 1
 }
 void CacheReplacement(Cache *currentCache, uint64_t address, ReplacementPolicy policy); // Declaring the cachereplacement to be used in cacheinsert
@@ -304,6 +403,7 @@ void CacheInsert(Cache *currentCache, uint64_t adress)
   AdressParts tag_index_off = GetTagIndexOffset(currentCache, adress);
 
     CacheSet *set = &currentCache->sets[tag_index_off.indexx];
+    PROFILE_BEGIN_SAMPLED(PROF_INSERT_SCAN, prof_start);
 
     for (int i = 0; i < currentCache->associativity; i++)
     {
@@ -313,9 +413,11 @@ void CacheInsert(Cache *currentCache, uint64_t adress)
         line->valid = 1;
         line->tag = tag_index_off.tag;
         line->markDirty = NOT_DIRTY;
+        PROFILE_END(PROF_INSERT_SCAN, prof_start);
         return;
       }
     }
+    PROFILE_END(PROF_INSERT_SCAN, prof_start);
     CacheReplacement(currentCache, adress, currentCache->replacement_policy);
   }
 // }
@@ -325,11 +427,12 @@ void CacheReplacement(Cache *currentCache, uint64_t address, ReplacementPolicy p
 // by changing the index_to_replace to be equal to the calculation for another replacement policy
 {
   // replacement policy for random
+  PROFILE_BEGIN_SAMPLED(PROF_REPLACEMENT, prof_start);
   AdressParts tag_index_off = GetTagIndexOffset(currentCache, address);
   int index_to_replace = 0;
   if (policy == RANDOM)
   {
-    index_to_replace = rand() % currentCache->associativity;
+    index_to_replace = RandomWay(currentCache);
   }
 
   CacheSet *set = &currentCache->sets[tag_index_off.indexx];
@@ -342,22 +445,27 @@ void CacheReplacement(Cache *currentCache, uint64_t address, ReplacementPolicy p
     */
     if (replaceLine->valid && replaceLine->markDirty == DIRTY)
     {
+      PROFILE_BEGIN(PROF_L2_WRITEBACK, prof_writeback);
       int offset_bits = log2(currentCache->line_size);
       int index_bits = log2(currentCache->amount_sets);
 
       uint64_t evicted_address = ((replaceLine->tag << index_bits) | tag_index_off.indexx) << offset_bits;
+      REGIONS_RECORD(REGION_WRITEBACK, evicted_address);
 
       if (CacheLookup(L2, evicted_address))
         L2->hit_miss.write_hit++;
       else
       {
         L2->hit_miss.write_miss++;
+        REGIONS_RECORD(REGION_L2_MISS, evicted_address);
         CacheInsert(L2, evicted_address);
       }
+      PROFILE_END(PROF_L2_WRITEBACK, prof_writeback);
     }
     replaceLine->valid = 1;
     replaceLine->tag = tag_index_off.tag;
     replaceLine->markDirty = NOT_DIRTY;
+    PROFILE_END(PROF_REPLACEMENT, prof_start);
 }
 
 void MarkDirty(Cache *currentCache, uint64_t address, Dirty dirty)
@@ -388,6 +496,12 @@ void MarkDirty(Cache *currentCache, uint64_t address, Dirty dirty)
 void memory_fetch(uint64_t address, data_t *data)
 //Fetch instruction call from the cpu
 {
+  if (regions_enabled)
+  {
+    regions_record(REGION_ACCESS, address);
+    regions_access(REUSE_INSTR, address / L1I->line_size);
+  }
+
   if (CacheLookup(L1I, address))
   {
     L1I->hit_miss.read_hit++;
@@ -395,6 +509,7 @@ void memory_fetch(uint64_t address, data_t *data)
   else
   {
     L1I->hit_miss.read_miss++;
+    REGIONS_RECORD(REGION_L1I_MISS, address);
     if (CacheLookup(L2, address))
     {
       L2->hit_miss.read_hit++;
@@ -403,6 +518,7 @@ void memory_fetch(uint64_t address, data_t *data)
     else
     {
       L2->hit_miss.read_miss++;
+      REGIONS_RECORD(REGION_L2_MISS, address);
       CacheInsert(L2, address); 
       CacheInsert(L1I, address); 
     }
@@ -416,6 +532,11 @@ void memory_fetch(uint64_t address, data_t *data)
 void memory_read(uint64_t address, data_t *data)
 //Read instruction from the cpu
 {
+  if (regions_enabled)
+  {
+    regions_record(REGION_ACCESS, address);
+    regions_access(REUSE_DATA, address / L1D->line_size);
+  }
 
   if (CacheLookup(L1D, address))
   {
@@ -424,6 +545,7 @@ void memory_read(uint64_t address, data_t *data)
   else
   {
     L1D->hit_miss.read_miss++;
+    REGIONS_RECORD(REGION_L1D_MISS, address);
     if (CacheLookup(L2, address))
     {
       L2->hit_miss.read_hit++;
@@ -433,6 +555,7 @@ void memory_read(uint64_t address, data_t *data)
     {
 
       L2->hit_miss.read_miss++;
+      REGIONS_RECORD(REGION_L2_MISS, address);
       CacheInsert(L2, address);
       CacheInsert(L1D, address);
     }
@@ -446,6 +569,11 @@ void memory_read(uint64_t address, data_t *data)
 void memory_write(uint64_t address, data_t *data)
 //Write instruction from the cpu
 {
+  if (regions_enabled)
+  {
+    regions_record(REGION_ACCESS, address);
+    regions_access(REUSE_DATA, address / L1D->line_size);
+  }
 
   // --------- WRITE THROUGH POLICY -------- //
   if (L1D->write_policy == WRITE_THROUGH)
@@ -461,12 +589,14 @@ void memory_write(uint64_t address, data_t *data)
       else
       {
         L2->hit_miss.write_miss++;
+        REGIONS_RECORD(REGION_L2_MISS, address);
         CacheInsert(L2, address);
       }
     }
     else
     {
       L1D->hit_miss.write_miss++;
+      REGIONS_RECORD(REGION_L1D_MISS, address);
       if (CacheLookup(L2, address))
       {
         L2->hit_miss.write_hit++;
@@ -475,6 +605,7 @@ void memory_write(uint64_t address, data_t *data)
       else
       {
         L2->hit_miss.write_miss++;
+        REGIONS_RECORD(REGION_L2_MISS, address);
         CacheInsert(L2, address);
         CacheInsert(L1D, address);
       }
@@ -492,6 +623,7 @@ void memory_write(uint64_t address, data_t *data)
     else
     {
       L1D->hit_miss.write_miss++;
+      REGIONS_RECORD(REGION_L1D_MISS, address);
       CacheInsert(L1D,address);
       MarkDirty(L1D,address, DIRTY);
       if (CacheLookup(L2, address))
@@ -501,6 +633,7 @@ void memory_write(uint64_t address, data_t *data)
       else
       {
         L2->hit_miss.write_miss++;
+        REGIONS_RECORD(REGION_L2_MISS, address);
         CacheInsert(L2, address);
       }
     }
@@ -11,6 +11,14 @@
  */
 typedef uint64_t data_t;
 
+/** Set the seed of the random replacement policy. Each cache derives its
+ *  own generator from it, so a given seed always gives the same evictions.
+ *  Must be called before memory_init() to take effect.
+ *
+ *  @param[in] seed Seed for the per-cache generators.
+ */
+void memory_set_seed(uint64_t seed);
+
 /** Initialize memory hierarchy.
  */
 void memory_init(void);
@@ -0,0 +1,93 @@
+/** @file profile.c
+ *  @brief Section timers and lookup-length histograms for `--profile`.
+ *  @see profile.h
+ */
+
+#include "profile.h"
+
+#ifdef CACHESIM_PROFILE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PROFILE_UNIT "cycles"
+#else
+#define PROFILE_UNIT "ns"
+#endif
+
+#define CALIBRATION_ROUNDS 1000
+
+int profile_enabled;
+uint64_t profile_overhead;
+SectionTimer profile_timers[PROF_SECTIONS];
+LookupHistogram profile_lookups[PROF_LEVELS];
+
+static const char *section_names[PROF_SECTIONS] = {
+    "trace read",
+    "GetTagIndexOffset",
+    "lookup scan",
+    "insert scan",
+    "CacheReplacement",
+    "L2 write-back",
+};
+
+static const char *level_names[PROF_LEVELS] = {"L1I", "L1D", "L2"};
+
+void profile_enable(void)
+//Takes the cheapest of CALIBRATION_ROUNDS empty timer pairs as the fixed cost of one measurement
+{
+  uint64_t best = UINT64_MAX;
+  for (int i = 0; i < CALIBRATION_ROUNDS; i++)
+  {
+    uint64_t start = profile_now();
+    uint64_t ticks = profile_now() - start;
+    if (ticks < best)
+      best = ticks;
+  }
+  profile_overhead = best;
+  profile_enabled = 1;
+}
+
+void profile_report(void)
+//Prints one line per section followed by the lookup-length histogram of each level.
+{
+  printf(" ------- PROFILE (%s, inclusive of nested sections) --------- \n", PROFILE_UNIT);
+  printf("Timer overhead of %" PRIu64 " %s per timed call already subtracted\n", profile_overhead, PROFILE_UNIT);
+  for (int i = 0; i < PROF_SECTIONS; i++)
+  {
+    // sampled sections are scaled from the timed calls up to all calls
+    SectionTimer *t = &profile_timers[i];
+    double avg = t->timed ? (double)t->ticks / t->timed : 0.0;
+    printf("%-18s calls: %12" PRIu64 "  timed: %10" PRIu64 "  est. total: %14.0f  avg: %8.1f\n",
+           section_names[i], t->calls, t->timed, avg * t->calls, avg);
+  }
+
+  for (int level = 0; level < PROF_LEVELS; level++)
+  {
+    uint64_t hits = 0;
+    uint64_t scanned = 0;
+    for (int ways = 1; ways <= PROFILE_MAX_WAYS; ways++)
+    {
+      hits += profile_lookups[level].hits_after[ways];
+      scanned += profile_lookups[level].hits_after[ways] * ways;
+    }
+
+    printf("-- %-3s lookups -- hits: %" PRIu64 "  misses: %" PRIu64 "  [Avg ways to hit: %.2f]\n",
+           level_names[level], hits, profile_lookups[level].misses,
+           hits ? (double)scanned / hits : 0.0);
+    for (int ways = 1; ways <= PROFILE_MAX_WAYS; ways++)
+    {
+      if (profile_lookups[level].hits_after[ways] == 0)
+        continue;
+      printf("          %s%2d way(s): %12" PRIu64 "  (%.2f%%)\n",
+             ways == PROFILE_MAX_WAYS ? ">=" : "  ", ways,
+             profile_lookups[level].hits_after[ways],
+             100.0 * profile_lookups[level].hits_after[ways] / hits);
+    }
+  }
+  printf("\n");
+}
+
+#endif // CACHESIM_PROFILE
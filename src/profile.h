@@ -0,0 +1,155 @@
+/** @file profile.h
+ *  @brief Compile-time gated instrumentation of the simulator hot paths.
+ *
+ *  Build with `make PROFILE=1` to define CACHESIM_PROFILE. Without it every
+ *  macro below expands to nothing, so the instrumentation costs nothing.
+ *  With it the counters are always compiled in, but the section timers and
+ *  histograms are only updated once profile_enabled is set (`--profile`).
+ *  Sections that run several times per access only time one call in
+ *  PROFILE_SAMPLE_EVERY so the timers stay cheap enough for long sweeps.
+ *  @see profile.c
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+#include <stdint.h>
+
+typedef enum // the timed sections of the simulator, timers are inclusive of nested sections
+{
+  PROF_TRACE_READ,
+  PROF_TAG_INDEX_OFFSET,
+  PROF_LOOKUP_SCAN,
+  PROF_INSERT_SCAN,
+  PROF_REPLACEMENT,
+  PROF_L2_WRITEBACK,
+  PROF_SECTIONS,
+} ProfileSection;
+
+typedef enum // cache levels that get their own lookup-length histogram
+{
+  PROF_L1I,
+  PROF_L1D,
+  PROF_L2,
+  PROF_LEVELS,
+} ProfileLevel;
+
+// Lookups that hit after scanning more ways than this land in the last bucket
+#define PROFILE_MAX_WAYS 32
+
+// Sampled sections time one call in this many, must be a power of two
+#define PROFILE_SAMPLE_EVERY 64
+
+#ifdef CACHESIM_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+typedef struct // accumulated time of one section
+{
+  uint64_t calls; // every call, timed or not
+  uint64_t timed; // calls that were actually timed
+  uint64_t ticks; // time of the timed calls, timer overhead already subtracted
+} SectionTimer;
+
+typedef struct // lookup-length histogram of one cache level
+{
+  uint64_t hits_after[PROFILE_MAX_WAYS + 1]; // index = ways scanned before the hit
+  uint64_t misses;
+} LookupHistogram;
+
+extern int profile_enabled;
+extern uint64_t profile_overhead;
+extern SectionTimer profile_timers[PROF_SECTIONS];
+extern LookupHistogram profile_lookups[PROF_LEVELS];
+
+/** Read the profiling clock. Uses the time stamp counter on x86 and
+ *  clock_gettime(CLOCK_MONOTONIC) in nanoseconds everywhere else.
+ */
+static inline uint64_t profile_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/** Count one call of a section and start its timer if this call is sampled.
+ *
+ *  @param[in] section Section being entered.
+ *  @param[in] every Time one call in this many.
+ *  @return Start time, or 0 if this call is not timed.
+ */
+static inline uint64_t profile_start(ProfileSection section, uint64_t every)
+{
+  if (profile_timers[section].calls++ & (every - 1))
+    return 0;
+  return profile_now();
+}
+
+/** Stop the timer of a section started by profile_start().
+ *
+ *  @param[in] section Section being left.
+ *  @param[in] start Value returned by profile_start().
+ */
+static inline void profile_add(ProfileSection section, uint64_t start)
+{
+  uint64_t ticks = profile_now() - start;
+  profile_timers[section].timed++;
+  profile_timers[section].ticks += ticks > profile_overhead ? ticks - profile_overhead : 0;
+}
+
+/** Record the outcome of one cache lookup.
+ *
+ *  @param[in] level Cache level that was searched.
+ *  @param[in] ways Number of ways scanned before the hit, 0 for a miss.
+ */
+static inline void profile_lookup(ProfileLevel level, int ways)
+{
+  if (ways == 0)
+    profile_lookups[level].misses++;
+  else
+    profile_lookups[level].hits_after[ways < PROFILE_MAX_WAYS ? ways : PROFILE_MAX_WAYS]++;
+}
+
+/** Enable profiling and measure the cost of an empty timer pair, which is
+ *  subtracted from every timed call and printed in the report.
+ */
+void profile_enable(void);
+
+/** Print the section timers and lookup-length histograms to stdout.
+ */
+void profile_report(void);
+
+#define PROFILE_BEGIN_EVERY(section, var, every) \
+  uint64_t var = profile_enabled ? profile_start((section), (every)) : 0
+#define PROFILE_BEGIN(section, var) PROFILE_BEGIN_EVERY(section, var, 1)
+#define PROFILE_BEGIN_SAMPLED(section, var) PROFILE_BEGIN_EVERY(section, var, PROFILE_SAMPLE_EVERY)
+#define PROFILE_END(section, var)          \
+  do                                       \
+  {                                        \
+    if (var)                               \
+      profile_add((section), (var));       \
+  } while (0)
+#define PROFILE_LOOKUP(level, ways)      \
+  do                                     \
+  {                                      \
+    if (profile_enabled)                 \
+      profile_lookup((level), (ways));   \
+  } while (0)
+
+#else
+
+#define PROFILE_BEGIN(section, var)
+#define PROFILE_BEGIN_SAMPLED(section, var)
+#define PROFILE_END(section, var) ((void)0)
+#define PROFILE_LOOKUP(level, ways) ((void)0)
+
+#endif // CACHESIM_PROFILE
+
+#endif // profile.h
@@ -0,0 +1,471 @@
+/** @file regions.c
+ *  @brief Per-region miss heatmap and reuse-distance histograms.
+ *  @see regions.h
+ */
+
+#include "regions.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Region table capacity. Regions beyond 3/4 of it are folded into "other".
+#define REGION_TABLE_SIZE 4096
+#define REGION_TABLE_LIMIT (REGION_TABLE_SIZE / 4 * 3)
+
+// Reuse distances are exact up to this many accesses back, older reuses land in one bucket
+#define REUSE_WINDOW (1 << 16)
+#define REUSE_TABLE_SIZE (2 * REUSE_WINDOW)
+#define REUSE_MAX_PROBES 32
+#define REUSE_BUCKETS 17 // 0, 1, 2-3, 4-7, ... up to REUSE_WINDOW - 1
+
+int regions_enabled;
+
+typedef struct // one named address range from the range file, end is exclusive
+{
+  char name[32];
+  uint64_t start;
+  uint64_t end;
+} AddressRange;
+
+typedef struct // one slot in the region table
+{
+  int used;
+  uint64_t key; // page number, or index into ranges
+  uint64_t counts[REGION_EVENTS];
+} RegionEntry;
+
+typedef struct // last access time of one cache line
+{
+  int used;
+  uint64_t line;
+  uint64_t last;
+} ReuseEntry;
+
+typedef struct // reuse-distance state of one stream
+{
+  uint64_t time;
+  uint32_t tree[REUSE_WINDOW + 1]; // Fenwick tree over the marks, 1-based
+  uint8_t marked[REUSE_WINDOW];    // slot is the latest access of some line
+  ReuseEntry table[REUSE_TABLE_SIZE];
+  uint64_t buckets[REUSE_BUCKETS];
+  uint64_t cold_or_evicted; // first touch, or the line's stale entry was taken over
+  uint64_t evicted;         // stale entries taken over by another line
+  uint64_t beyond_window;
+  uint64_t untracked;
+} ReuseTracker;
+
+static uint64_t page_size;
+static AddressRange *ranges;
+static int range_count;
+static int top_n;
+static const char *csv_path;
+
+static RegionEntry *region_table;
+static int region_count;
+static RegionEntry other; // regions that did not fit, and addresses outside every range
+
+static ReuseTracker *trackers[REUSE_STREAMS];
+
+static const char *event_names[REGION_EVENTS] = {"accesses", "l1i_misses", "l1d_misses", "l2_misses", "writebacks"};
+static const char *stream_names[REUSE_STREAMS] = {"Instr", "Data"};
+
+static uint64_t hash64(uint64_t key)
+{
+  return key * 0x9E3779B97F4A7C15ULL;
+}
+
+static int compare_ranges(const void *a, const void *b)
+{
+  const AddressRange *ra = a, *rb = b;
+  return (ra->start > rb->start) - (ra->start < rb->start);
+}
+
+static int load_ranges(const char *path)
+//Reads "name start end" lines, numbers in any base strtoull accepts. Blank lines and # comments are skipped.
+{
+  FILE *f = fopen(path, "r");
+  if (f == NULL)
+  {
+    printf("Could not open file: %s\n", path);
+    return -1;
+  }
+
+  char line[256];
+  int capacity = 0;
+  int lineno = 0;
+  while (fgets(line, sizeof(line), f))
+  {
+    lineno++;
+    char name[32];
+    char start[32], end[32];
+    if (line[0] == '#' || line[0] == '\n')
+      continue;
+    if (sscanf(line, "%31s %31s %31s", name, start, end) != 3)
+    {
+      printf("%s:%d: expected \"name start end\"\n", path, lineno);
+      fclose(f);
+      return -1;
+    }
+    if (range_count == capacity)
+    {
+      capacity = capacity ? capacity * 2 : 16;
+      ranges = realloc(ranges, sizeof(AddressRange) * capacity);
+    }
+    AddressRange *r = &ranges[range_count++];
+    strcpy(r->name, name);
+    r->start = strtoull(start, NULL, 0);
+    r->end = strtoull(end, NULL, 0);
+    if (r->end <= r->start)
+    {
+      printf("%s:%d: range end must be above its start\n", path, lineno);
+      fclose(f);
+      return -1;
+    }
+  }
+  fclose(f);
+
+  if (range_count > REGION_TABLE_LIMIT)
+  {
+    printf("%s: at most %d ranges are supported\n", path, REGION_TABLE_LIMIT);
+    return -1;
+  }
+  qsort(ranges, range_count, sizeof(AddressRange), compare_ranges);
+  for (int i = 1; i < range_count; i++)
+  {
+    if (ranges[i].start < ranges[i - 1].end)
+    {
+      printf("%s: ranges %s and %s overlap\n", path, ranges[i - 1].name, ranges[i].name);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int regions_init(uint64_t page, const char *range_file, int top, const char *csv)
+{
+  if (range_file == NULL && page == 0)
+  {
+    printf("Region page size must be above 0\n");
+    return -1;
+  }
+  if (top < 1)
+  {
+    printf("Number of regions to report must be at least 1\n");
+    return -1;
+  }
+  if (range_file && load_ranges(range_file) != 0)
+    return -1;
+  if (range_file && range_count == 0)
+  {
+    printf("%s: no ranges found\n", range_file);
+    return -1;
+  }
+
+  page_size = page;
+  top_n = top;
+  csv_path = csv;
+  region_table = calloc(REGION_TABLE_SIZE, sizeof(RegionEntry));
+  for (int i = 0; i < REUSE_STREAMS; i++)
+    trackers[i] = calloc(1, sizeof(ReuseTracker));
+  regions_enabled = 1;
+  return 0;
+}
+
+static int region_key(uint64_t address, uint64_t *key)
+//Finds the region key of an address. Returns 0 if the address is outside every range.
+{
+  if (range_count == 0)
+  {
+    *key = address / page_size;
+    return 1;
+  }
+
+  int lo = 0, hi = range_count - 1;
+  while (lo <= hi)
+  {
+    int mid = (lo + hi) / 2;
+    if (address < ranges[mid].start)
+      hi = mid - 1;
+    else if (address >= ranges[mid].end)
+      lo = mid + 1;
+    else
+    {
+      *key = mid;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void regions_record(RegionEvent event, uint64_t address)
+{
+  uint64_t key;
+  if (!region_key(address, &key))
+  {
+    other.counts[event]++;
+    return;
+  }
+
+  // open addressing with linear probing, the table never fills past REGION_TABLE_LIMIT
+  uint64_t slot = hash64(key) >> 52; // 12 bits for 4096 slots
+  while (region_table[slot].used && region_table[slot].key != key)
+    slot = (slot + 1) & (REGION_TABLE_SIZE - 1);
+
+  RegionEntry *entry = &region_table[slot];
+  if (!entry->used)
+  {
+    if (region_count == REGION_TABLE_LIMIT)
+    {
+      other.counts[event]++;
+      return;
+    }
+    entry->used = 1;
+    entry->key = key;
+    region_count++;
+  }
+  entry->counts[event]++;
+}
+
+static void fenwick_add(ReuseTracker *r, uint32_t slot, int delta)
+{
+  for (uint32_t i = slot + 1; i <= REUSE_WINDOW; i += i & -i)
+    r->tree[i] += delta;
+}
+
+static uint64_t fenwick_prefix(ReuseTracker *r, uint32_t slots)
+//Number of marked slots in [0, slots)
+{
+  uint64_t sum = 0;
+  for (uint32_t i = slots; i > 0; i -= i & -i)
+    sum += r->tree[i];
+  return sum;
+}
+
+static uint64_t marks_between(ReuseTracker *r, uint64_t from, uint64_t to)
+//Number of marked slots strictly between two access times less than REUSE_WINDOW apart
+{
+  uint32_t lo = (from + 1) % REUSE_WINDOW;
+  uint32_t len = to - from - 1;
+  if (lo + len <= REUSE_WINDOW)
+    return fenwick_prefix(r, lo + len) - fenwick_prefix(r, lo);
+  return fenwick_prefix(r, REUSE_WINDOW) - fenwick_prefix(r, lo) + fenwick_prefix(r, lo + len - REUSE_WINDOW);
+}
+
+void regions_access(ReuseStream stream, uint64_t line)
+/*
+Reuse distance = number of distinct lines touched since the previous access to the same line.
+Each line's latest access time is marked in a ring of REUSE_WINDOW slots, so the distance is
+the number of marks between the two accesses. Lines are found in a bounded hash table where
+entries older than the window count as free, and a probe gives up after REUSE_MAX_PROBES.
+A line whose stale entry was taken over looks new when it returns, so it is counted as
+"cold or evicted" rather than beyond the window.
+*/
+{
+  ReuseTracker *r = trackers[stream];
+  uint64_t now = r->time++;
+  uint32_t slot = now % REUSE_WINDOW;
+
+  if (r->marked[slot]) // the access REUSE_WINDOW ago falls out of the window
+  {
+    r->marked[slot] = 0;
+    fenwick_add(r, slot, -1);
+  }
+
+  uint64_t start = hash64(line) >> 47; // 17 bits for REUSE_TABLE_SIZE slots
+  ReuseEntry *entry = NULL;
+  ReuseEntry *free_entry = NULL;
+  for (int i = 0; i < REUSE_MAX_PROBES; i++)
+  {
+    ReuseEntry *e = &r->table[(start + i) & (REUSE_TABLE_SIZE - 1)];
+    if (e->used && e->line == line)
+    {
+      entry = e;
+      break;
+    }
+    if (free_entry == NULL && (!e->used || now - e->last >= REUSE_WINDOW))
+      free_entry = e;
+  }
+
+  if (entry == NULL)
+  {
+    if (free_entry == NULL)
+      r->untracked++;
+    else
+    {
+      r->cold_or_evicted++;
+      if (free_entry->used)
+        r->evicted++;
+      entry = free_entry;
+      entry->used = 1;
+      entry->line = line;
+    }
+  }
+  else if (now - entry->last >= REUSE_WINDOW)
+    r->beyond_window++;
+  else
+  {
+    uint32_t last_slot = entry->last % REUSE_WINDOW;
+    uint64_t distance = marks_between(r, entry->last, now);
+    int bucket = 0;
+    while (distance >> bucket)
+      bucket++;
+    r->buckets[bucket]++;
+    r->marked[last_slot] = 0;
+    fenwick_add(r, last_slot, -1);
+  }
+
+  // an untracked access gets no mark, as no entry would ever clear it again
+  if (entry)
+  {
+    entry->last = now;
+    r->marked[slot] = 1;
+    fenwick_add(r, slot, 1);
+  }
+}
+
+static uint64_t region_misses(const RegionEntry *e)
+{
+  return e->counts[REGION_L1I_MISS] + e->counts[REGION_L1D_MISS] + e->counts[REGION_L2_MISS];
+}
+
+static int compare_regions(const void *a, const void *b)
+//Most misses first, then most write-backs, then lowest address
+{
+  const RegionEntry *ra = a, *rb = b;
+  uint64_t ma = region_misses(ra), mb = region_misses(rb);
+  if (ma != mb)
+    return ma < mb ? 1 : -1;
+  if (ra->counts[REGION_WRITEBACK] != rb->counts[REGION_WRITEBACK])
+    return ra->counts[REGION_WRITEBACK] < rb->counts[REGION_WRITEBACK] ? 1 : -1;
+  return (ra->key > rb->key) - (ra->key < rb->key);
+}
+
+static void region_bounds(const RegionEntry *e, uint64_t *start, uint64_t *end, const char **name)
+{
+  if (range_count)
+  {
+    *start = ranges[e->key].start;
+    *end = ranges[e->key].end;
+    *name = ranges[e->key].name;
+  }
+  else
+  {
+    *start = e->key * page_size;
+    *end = *start + page_size;
+    *name = "";
+  }
+}
+
+static void write_csv_name(FILE *f, const char *name)
+//Writes a name as a quoted CSV field, so commas and quotes in range names keep the columns intact
+{
+  fputc('"', f);
+  for (const char *c = name; *c; c++)
+  {
+    if (*c == '"')
+      fputc('"', f);
+    fputc(*c, f);
+  }
+  fputc('"', f);
+}
+
+static void write_csv(RegionEntry *sorted, int count)
+{
+  FILE *f = fopen(csv_path, "w");
+  if (f == NULL)
+  {
+    printf("Could not open file: %s\n", csv_path);
+    return;
+  }
+
+  fprintf(f, "name,start,end");
+  for (int e = 0; e < REGION_EVENTS; e++)
+    fprintf(f, ",%s", event_names[e]);
+  fprintf(f, "\n");
+
+  for (int i = 0; i < count; i++)
+  {
+    uint64_t start, end;
+    const char *name;
+    region_bounds(&sorted[i], &start, &end, &name);
+    write_csv_name(f, name);
+    fprintf(f, ",0x%" PRIx64 ",0x%" PRIx64, start, end);
+    for (int e = 0; e < REGION_EVENTS; e++)
+      fprintf(f, ",%" PRIu64, sorted[i].counts[e]);
+    fprintf(f, "\n");
+  }
+
+  write_csv_name(f, "other");
+  fprintf(f, ",,");
+  for (int e = 0; e < REGION_EVENTS; e++)
+    fprintf(f, ",%" PRIu64, other.counts[e]);
+  fprintf(f, "\n");
+  fclose(f);
+}
+
+static void print_reuse(int stream)
+{
+  ReuseTracker *r = trackers[stream];
+  printf("-- %-5s reuse distance (lines) -- accesses: %" PRIu64 "  cold or evicted: %" PRIu64
+         " (stale entries taken over: %" PRIu64 ")  beyond %d accesses: %" PRIu64 "  untracked: %" PRIu64 "\n",
+         stream_names[stream], r->time, r->cold_or_evicted, r->evicted, REUSE_WINDOW,
+         r->beyond_window, r->untracked);
+  for (int b = 0; b < REUSE_BUCKETS; b++)
+  {
+    if (r->buckets[b] == 0)
+      continue;
+    uint64_t lo = b ? 1ULL << (b - 1) : 0;
+    uint64_t hi = b ? (1ULL << b) - 1 : 0;
+    printf("          %7" PRIu64 " - %-7" PRIu64 ": %12" PRIu64 "  (%.2f%%)\n",
+           lo, hi, r->buckets[b], 100.0 * r->buckets[b] / r->time);
+  }
+}
+
+void regions_report(void)
+//Prints the top_n regions with the most misses followed by the reuse histograms.
+{
+  RegionEntry *sorted = malloc(sizeof(RegionEntry) * (region_count ? region_count : 1));
+  int count = 0;
+  for (int i = 0; i < REGION_TABLE_SIZE; i++)
+    if (region_table[i].used)
+      sorted[count++] = region_table[i];
+  qsort(sorted, count, sizeof(RegionEntry), compare_regions);
+  int shown = count < top_n ? count : top_n;
+
+  if (range_count)
+    printf(" ------- MISS HEATMAP (top %d of %d ranges) --------- \n", shown, count);
+  else
+    printf(" ------- MISS HEATMAP (top %d of %d regions, %" PRIu64 " byte pages) --------- \n",
+           shown, count, page_size);
+  printf("%-16s %-37s %12s %10s %10s %10s %10s\n",
+         "name", "region", "accesses", "L1I miss", "L1D miss", "L2 miss", "writebacks");
+  for (int i = 0; i < shown; i++)
+  {
+    uint64_t start, end;
+    const char *name;
+    region_bounds(&sorted[i], &start, &end, &name);
+    printf("%-16s 0x%016" PRIx64 "-0x%016" PRIx64 " %12" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+           name, start, end, sorted[i].counts[REGION_ACCESS], sorted[i].counts[REGION_L1I_MISS],
+           sorted[i].counts[REGION_L1D_MISS], sorted[i].counts[REGION_L2_MISS], sorted[i].counts[REGION_WRITEBACK]);
+  }
+  printf("%-16s %-37s %12" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+         "other", "", other.counts[REGION_ACCESS], other.counts[REGION_L1I_MISS],
+         other.counts[REGION_L1D_MISS], other.counts[REGION_L2_MISS], other.counts[REGION_WRITEBACK]);
+
+  for (int s = 0; s < REUSE_STREAMS; s++)
+    print_reuse(s);
+  printf("\n");
+
+  if (csv_path)
+    write_csv(sorted, count);
+
+  free(sorted);
+  free(region_table);
+  free(ranges);
+  for (int i = 0; i < REUSE_STREAMS; i++)
+    free(trackers[i]);
+  regions_enabled = 0;
+}
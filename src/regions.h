@@ -0,0 +1,69 @@
+/** @file regions.h
+ *  @brief Attributes misses and write-backs to address regions and builds
+ *  reuse-distance histograms per access stream.
+ *
+ *  Regions are either fixed-size pages or named ranges read from a file.
+ *  All tables have a fixed capacity, so memory use does not grow with the
+ *  trace. Everything is off until regions_init() succeeds.
+ *  @see regions.c
+ */
+
+#ifndef REGIONS_H
+#define REGIONS_H
+#include <stdint.h>
+
+typedef enum // events counted per region
+{
+  REGION_ACCESS,
+  REGION_L1I_MISS,
+  REGION_L1D_MISS,
+  REGION_L2_MISS,
+  REGION_WRITEBACK,
+  REGION_EVENTS,
+} RegionEvent;
+
+typedef enum // access streams that get their own reuse-distance histogram
+{
+  REUSE_INSTR,
+  REUSE_DATA,
+  REUSE_STREAMS,
+} ReuseStream;
+
+extern int regions_enabled;
+
+/** Enable region attribution.
+ *
+ *  @param[in] page_size Region size in bytes when range_file is NULL.
+ *  @param[in] range_file File with one "name start end" range per line, or NULL.
+ *  @param[in] top_n Number of regions printed by regions_report().
+ *  @param[in] csv_path File that receives every region as CSV, or NULL.
+ *  @return 0 on success, -1 if the arguments or the range file are invalid.
+ */
+int regions_init(uint64_t page_size, const char *range_file, int top_n, const char *csv_path);
+
+/** Count one event against the region containing an address.
+ *
+ *  @param[in] event Event to count.
+ *  @param[in] address Memory address the event belongs to.
+ */
+void regions_record(RegionEvent event, uint64_t address);
+
+/** Feed one access into the reuse-distance histogram of a stream.
+ *
+ *  @param[in] stream Stream the access belongs to.
+ *  @param[in] line Cache line number of the access (address / line size).
+ */
+void regions_access(ReuseStream stream, uint64_t line);
+
+/** Print the top regions and reuse histograms, write the CSV and free all tables.
+ */
+void regions_report(void);
+
+#define REGIONS_RECORD(event, address)      \
+  do                                        \
+  {                                         \
+    if (regions_enabled)                    \
+      regions_record((event), (address));   \
+  } while (0)
+
+#endif // regions.h
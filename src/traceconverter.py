@@ -16,6 +16,10 @@
 #
 # Output is saved in trace.tr
 #
+# cachesim can also read the log directly, skipping this conversion:
+# ./cachesim --lackey logfile
+# valgrind --tool=lackey --trace-mem=yes --log-fd=1 [your-program-name] | ./cachesim -
+#
 
 from struct import pack
 